@@ -0,0 +1,166 @@
+#pragma once
+
+#include "config.hpp"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Rozwija listę procesorów w formacie sysfs, np. "0-3,8,10-11"
+std::vector<int> parseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::string readLine(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+// Rdzenie fizyczne (każdy jako lista hyperwątków) pogrupowane według
+// węzłów NUMA. Uwzględniamy tylko procesory, na których wolno nam działać.
+std::vector<std::vector<std::vector<int>>> readTopology() {
+  cpu_set_t allowed;
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+
+  std::map<int, int> cpu_node;
+  for (int node = 0;; node++) {
+    auto list = readLine("/sys/devices/system/node/node" +
+                         std::to_string(node) + "/cpulist");
+    if (list.empty()) {
+      break;
+    }
+    for (int cpu : parseCpuList(list)) {
+      cpu_node[cpu] = node;
+    }
+  }
+
+  std::map<int, std::map<int, std::vector<int>>> cores; // node -> core -> cpus
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+    auto siblings = parseCpuList(readLine(
+        "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+        "/topology/thread_siblings_list"));
+    int core = siblings.empty() ? cpu : siblings.front();
+    cores[cpu_node[cpu]][core].push_back(cpu);
+  }
+
+  std::vector<std::vector<std::vector<int>>> topology;
+  for (auto &[node, node_cores] : cores) {
+    topology.emplace_back();
+    for (auto &[core, cpus] : node_cores) {
+      topology.back().push_back(cpus);
+    }
+  }
+  return topology;
+}
+
+void setAffinity(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Zestawy procesorów, z których każdy pomieści oba wątki jednego procesu:
+// rdzeń z co najmniej dwoma hyperwątkami albo, bez SMT, para sąsiednich
+// rdzeni tego samego węzła NUMA. Pogrupowane według węzłów.
+std::vector<std::vector<std::vector<int>>> readSlots() {
+  std::vector<std::vector<std::vector<int>>> slots;
+  for (auto &node : readTopology()) {
+    std::vector<std::vector<int>> node_slots;
+    std::vector<int> pair;
+    for (auto &core : node) {
+      if (core.size() >= 2) {
+        node_slots.push_back(core);
+        continue;
+      }
+
+      pair.push_back(core.front());
+      if (pair.size() == 2) {
+        node_slots.push_back(pair);
+        pair.clear();
+      }
+    }
+
+    if (!node_slots.empty()) {
+      slots.push_back(node_slots);
+    }
+  }
+  return slots;
+}
+
+// Przypina bieżący wątek do zestawu procesorów wybranego dla procesu
+// o danym numerze w obrębie węzła (local_rank). Trzeba to zrobić przed
+// utworzeniem procesu, żeby jego dane zostały zaalokowane (first-touch)
+// w pamięci lokalnego węzła NUMA. Jeśli nie da się dać obu wątkom
+// osobnych procesorów, przypinanie jest wyłączane - wątek pierwszoplanowy
+// kręcący się w pętli zagłodziłby wątek odbierający ACK.
+void pinProcess(Config &config, int local_rank) {
+  if (config.pinning == Config::Pinning::NONE) {
+    return;
+  }
+
+  auto slots = readSlots();
+  if (slots.empty()) {
+    std::cerr << "Proces " << local_rank
+              << ": za mało procesorów, żeby rozdzielić wątki - "
+                 "przypinanie wyłączone\n";
+    config.pinning = Config::Pinning::NONE;
+    return;
+  }
+
+  std::vector<int> slot;
+  if (config.pinning == Config::Pinning::PACKED) {
+    std::vector<std::vector<int>> all_slots;
+    for (auto &node : slots) {
+      all_slots.insert(all_slots.end(), node.begin(), node.end());
+    }
+    slot = all_slots[local_rank % all_slots.size()];
+  } else {
+    auto &node = slots[local_rank % slots.size()];
+    slot = node[(local_rank / slots.size()) % node.size()];
+  }
+
+  setAffinity(slot);
+}
+
+// Zawęża przypięcie bieżącego wątku do n-tego procesora zestawu,
+// do którego przypięty jest cały proces
+void pinThreadToSibling(int n) {
+  cpu_set_t current;
+  pthread_getaffinity_np(pthread_self(), sizeof(current), &current);
+
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &current)) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  // Oba wątki na jednym procesorze to gorzej niż brak przypięcia
+  if (cpus.size() >= 2) {
+    setAffinity({cpus[n % cpus.size()]});
+  }
+}
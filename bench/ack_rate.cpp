@@ -0,0 +1,203 @@
+// Mikrobenchmark obsługi ACK: porównuje stary układ pól (flaga wait_ready
+// i liczniki chronione mutexami, upakowane obok siebie) z wyrównanym do
+// linii pamięci podręcznej atomowym odliczaniem. Wątek "w tle" przetwarza
+// ACK tak szybko, jak to możliwe, a wątek pierwszoplanowy odpytuje w pętli,
+// czy zebrał już wszystkie. Liczniki sprzętowe czytane są przez
+// perf_event_open (jeśli system na to pozwala).
+//
+// Kompilacja: mpicxx -std=c++17 -O2 bench/ack_rate.cpp -o ack_rate
+// Uruchomienie: ./ack_rate [liczba_rund] [liczba_ack_na_runde]
+
+#include <mpi.h>
+
+#include "../utils.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct PerfCounters {
+  struct Counter {
+    const char *name;
+    uint64_t config;
+    int fd;
+  };
+
+  std::vector<Counter> counters = {
+      {"cycles", PERF_COUNT_HW_CPU_CYCLES, -1},
+      {"instructions", PERF_COUNT_HW_INSTRUCTIONS, -1},
+      {"cache-misses", PERF_COUNT_HW_CACHE_MISSES, -1},
+  };
+
+  PerfCounters() {
+    for (auto &counter : counters) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = counter.config;
+      attr.disabled = 1;
+      attr.inherit = 1; // liczymy także wątki utworzone po włączeniu
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      counter.fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+  }
+
+  ~PerfCounters() {
+    for (auto &counter : counters) {
+      if (counter.fd >= 0) {
+        close(counter.fd);
+      }
+    }
+  }
+
+  void start() {
+    for (auto &counter : counters) {
+      if (counter.fd >= 0) {
+        ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+  }
+
+  void stop() {
+    for (auto &counter : counters) {
+      if (counter.fd >= 0) {
+        ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+    }
+  }
+
+  void print(long acks) {
+    for (auto &counter : counters) {
+      std::cout << "\t" << counter.name << " / ACK: ";
+      uint64_t value;
+      if (counter.fd >= 0 &&
+          read(counter.fd, &value, sizeof(value)) == sizeof(value)) {
+        std::cout << double(value) / acks << "\n";
+      } else {
+        std::cout << "niedostępne\n";
+      }
+    }
+  }
+};
+
+// Układ pól sprzed zmiany
+struct LegacyState {
+  bool want_to_enter_critical_section = false;
+  bool wait_ready = false;
+  std::mutex wait_ready_mutex;
+  int ack_counter = 0;
+  std::mutex data_mutex;
+
+  void request(int acks) {
+    data_mutex.lock();
+    want_to_enter_critical_section = true;
+    ack_counter = acks;
+    data_mutex.unlock();
+
+    while (true) {
+      wait_ready_mutex.lock();
+      bool x = wait_ready;
+      wait_ready_mutex.unlock();
+
+      if (x) {
+        break;
+      }
+    }
+
+    wait_ready_mutex.lock();
+    wait_ready = false;
+    wait_ready_mutex.unlock();
+
+    data_mutex.lock();
+    want_to_enter_critical_section = false;
+    data_mutex.unlock();
+  }
+
+  void processAck() {
+    data_mutex.lock();
+    if (ack_counter > 0) {
+      ack_counter--;
+      if (ack_counter == 0) {
+        wait_ready_mutex.lock();
+        wait_ready = true;
+        wait_ready_mutex.unlock();
+      }
+    }
+    data_mutex.unlock();
+  }
+};
+
+// Układ pól z Winemaker/Student: odliczanie ACK to ten sam typ, którego
+// używają procesy, a region chroniony przez data_mutex jest odwzorowany
+// tylko w zakresie pól potrzebnych do pomiaru
+struct PaddedState {
+  AckCountdown ack_counter;
+
+  alignas(CACHE_LINE_SIZE) std::mutex data_mutex;
+  bool want_to_enter_critical_section = false;
+
+  void request(int acks) {
+    data_mutex.lock();
+    want_to_enter_critical_section = true;
+    ack_counter.reset(acks);
+    data_mutex.unlock();
+
+    ack_counter.wait();
+
+    data_mutex.lock();
+    want_to_enter_critical_section = false;
+    data_mutex.unlock();
+  }
+
+  void processAck() {
+    if (ack_counter.pending()) {
+      ack_counter.ack();
+    }
+  }
+};
+
+template <typename State> void run(const char *name, long rounds, int acks) {
+  State state;
+  std::atomic<bool> stop{false};
+  PerfCounters perf;
+
+  perf.start();
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread background([&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      state.processAck();
+    }
+  });
+
+  for (long i = 0; i < rounds; i++) {
+    state.request(acks);
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  stop = true;
+  background.join();
+  perf.stop();
+
+  auto seconds = std::chrono::duration<double>(elapsed).count();
+  std::cout << name << ": " << rounds * acks / seconds << " ACK/s\n";
+  perf.print(rounds * acks);
+}
+
+int main(int argc, char *argv[]) {
+  long rounds = argc > 1 ? std::atol(argv[1]) : 100000;
+  int acks = argc > 2 ? std::atoi(argv[2]) : 9;
+
+  run<LegacyState>("mutex + wait_ready", rounds, acks);
+  run<PaddedState>("atomic, wyrównane", rounds, acks);
+}
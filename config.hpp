@@ -1,11 +1,24 @@
 #pragma once
 
 #include <functional>
+#include <string>
 #include <vector>
 
 // Zawsze musi być przynajmniej 1 winiarz i 1 student!
+// Procesy 1..observers-1 (jeśli są) to agregatory telemetrii
 struct Config {
+  enum class Distribution { UNIFORM, POISSON, ZIPF, BURSTY };
+  enum class SelectionPolicy {
+    FIRST_FIT,
+    BEST_FIT,
+    LARGEST_FIRST,
+    DEMAND_MATCHING
+  };
+  enum class Pinning { NONE, PACKED, SPREAD };
+  enum class ScheduleMode { NONE, RECORD, REPLAY };
+
   bool dev = true;
+  unsigned seed = 0;
 
   int observers = 1;
   int winemakers = 5;
@@ -15,8 +28,63 @@ struct Config {
   int max_wine_demand = 10;
   int max_sleep_time = 5;
 
+  // Rozkłady ilości wina i czasu odpoczynku (patrz workload.hpp)
+  Distribution production_distribution = Distribution::UNIFORM;
+  Distribution demand_distribution = Distribution::UNIFORM;
+  Distribution sleep_distribution = Distribution::UNIFORM;
+  double zipf_exponent = 1.0;
+  double burst_switch_probability = 0.1;
+
+  // Sposób wybierania meliny przez studenta (patrz safe_places.hpp)
+  SelectionPolicy selection_policy = SelectionPolicy::BEST_FIT;
+
+  // Przypinanie procesów do rdzeni (patrz affinity.hpp). Oba wątki procesu
+  // trafiają na hyperwątki tego samego rdzenia (bez SMT na dwa sąsiednie
+  // rdzenie), a procesy są upychane kolejno (PACKED) albo rozkładane
+  // na przemian po węzłach NUMA (SPREAD).
+  Pinning pinning = Pinning::NONE;
+
+  // Co ile sekcji krytycznych proces wypisuje średni czas czekania na ACK
+  int ack_latency_report_interval = 1000;
+
+  // Zapis (RECORD) i odtwarzanie (REPLAY) kolejności odbieranych wiadomości
+  // oraz wylosowanych wartości, żeby dało się powtórzyć dany przebieg
+  // (patrz schedule.hpp)
+  ScheduleMode schedule_mode = ScheduleMode::NONE;
+  std::string schedule_dir = "log/schedule";
+  int schedule_flush_interval_ms = 100;
+  // Jak długo odtwarzany odbiór czeka na nadawcę z nagrania, zanim uzna,
+  // że przebieg się rozjechał, i wróci do zwykłego odbioru
+  int schedule_replay_timeout_ms = 1000;
+
+  // Zdarzenia dla obserwatora są buforowane i wysyłane paczkami
+  int telemetry_batch_size = 16;
+  int telemetry_flush_interval_ms = 100;
+  int telemetry_fanout = 4;
+
   int getTotalProcessesNumber() { return observers + winemakers + students; }
 
+  bool isObserver(int process_id) { return process_id < observers; }
+
+  bool isWinemaker(int process_id) {
+    return process_id >= observers && process_id < observers + winemakers;
+  }
+
+  // Rodzic w drzewie agregacji telemetrii. Agregatory tworzą drzewo
+  // o stopniu telemetry_fanout z korzeniem w procesie 0, a winiarze
+  // i studenci są rozkładani po równo między wszystkie agregatory.
+  int getTelemetryParent(int process_id) {
+    if (isObserver(process_id)) {
+      return (process_id - 1) / telemetry_fanout;
+    }
+
+    int aggregators = observers - 1;
+    if (aggregators == 0) {
+      return 0;
+    }
+    return 1 + (process_id - observers) % aggregators;
+  }
+
   int getWinemakerIdFromPid(int process_id) { return process_id - observers; }
 
   int getStudentIdFromPid(int process_id) {
@@ -1,6 +1,6 @@
+#include "affinity.hpp"
 #include "config.hpp"
 #include "workers.hpp"
-#include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <memory>
@@ -22,12 +22,27 @@ int main(int argc, char *argv[]) {
 
   int process_id;
   MPI_Comm_rank(MPI_COMM_WORLD, &process_id);
-  srand(config.dev ? process_id : (time(NULL) + process_id));
+  // Ziarno musi być takie samo we wszystkich procesach, a Workload
+  // uzależnia je dodatkowo od pid
+  if (!config.dev) {
+    config.seed = time(NULL);
+  }
+  MPI_Bcast(&config.seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+
+  MPI_Comm node_comm;
+  int local_rank;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, process_id,
+                      MPI_INFO_NULL, &node_comm);
+  MPI_Comm_rank(node_comm, &local_rank);
+  MPI_Comm_free(&node_comm);
+  pinProcess(config, local_rank);
 
   std::unique_ptr<Runnable> process;
   if (process_id == 0) {
     process = std::make_unique<Observer>(config, process_id);
-  } else if (process_id <= config.winemakers) {
+  } else if (config.isObserver(process_id)) {
+    process = std::make_unique<Aggregator>(config, process_id);
+  } else if (config.isWinemaker(process_id)) {
     process = std::make_unique<Winemaker>(config, process_id);
   } else {
     process = std::make_unique<Student>(config, process_id);
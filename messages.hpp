@@ -25,6 +25,14 @@ struct ObserverMessage {
     // Student odebrał wino z meliny
     // > Payload(_pid, clock, safeplace_id, wine_amount)
     STUDENT_SAFE_PLACE_UPDATED = 105,
+
+    // Paczka powyższych zdarzeń (od procesu lub agregatora telemetrii)
+    // > [clock, (message, _pid, clock, safeplace_id, wine_amount)*]
+    TELEMETRY_BATCH = 106,
+
+    // Zegar procesu doszedł do podanej wartości (nie zmienia stanu)
+    // > Payload(_pid, clock)
+    TELEMETRY_WATERMARK = 107,
   };
 };
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "config.hpp"
+#include <iterator>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Lokalna kopia stanu melin z indeksem po ilości wina, dzięki któremu
+// wybór meliny nie wymaga przeglądania wszystkich melin
+class SafePlaces {
+  std::vector<int> amounts;
+  std::vector<int> clocks; // zegar ostatniej zmiany każdej meliny
+  std::set<int> empty;
+  std::set<int> non_empty;
+  std::set<std::pair<int, int>> by_amount; // (wine_amount, safe_place_id)
+
+public:
+  explicit SafePlaces(int size) : amounts(size, 0), clocks(size, -1) {
+    for (int i = 0; i < size; i++) {
+      empty.insert(i);
+    }
+  }
+
+  int size() const { return amounts.size(); }
+
+  int operator[](int id) const { return amounts[id]; }
+
+  // Aktualizacje od różnych procesów mogą przyjść w innej kolejności, niż
+  // zostały wysłane, więc starsza (wg zegara Lamporta) od już znanej jest
+  // pomijana. Zmiany w sekcji krytycznej są przyczynowo późniejsze od
+  // wszystkich, które proces zna, więc zegar lokalnej zmiany wystarczy
+  // wziąć z bieżącego zegara procesu.
+  void set(int id, int wine_amount, int clock) {
+    if (clock <= clocks[id]) {
+      return;
+    }
+    clocks[id] = clock;
+
+    auto &r = amounts[id];
+    if (r > 0) {
+      non_empty.erase(id);
+      by_amount.erase({r, id});
+    } else {
+      empty.erase(id);
+    }
+
+    r = wine_amount;
+    if (r > 0) {
+      non_empty.insert(id);
+      by_amount.insert({r, id});
+    } else {
+      empty.insert(id);
+    }
+  }
+
+  // Pusta melina o najmniejszym numerze albo -1
+  int findEmpty() const { return empty.empty() ? -1 : *empty.begin(); }
+
+  // Melina, z której student o danym zapotrzebowaniu powinien teraz
+  // zabrać wino, albo -1 jeśli wszystkie są puste
+  int select(Config::SelectionPolicy policy, int demand) const {
+    if (by_amount.empty()) {
+      return -1;
+    }
+
+    auto largest = std::prev(by_amount.end())->second;
+    auto fitting = by_amount.lower_bound({demand, -1});
+
+    switch (policy) {
+    case Config::SelectionPolicy::FIRST_FIT:
+      return *non_empty.begin();
+
+    case Config::SelectionPolicy::LARGEST_FIRST:
+      return largest;
+
+    case Config::SelectionPolicy::BEST_FIT:
+      // Najmniejsza melina pokrywająca całe zapotrzebowanie
+      return fitting != by_amount.end() ? fitting->second : largest;
+
+    case Config::SelectionPolicy::DEMAND_MATCHING:
+      // Dokładne dopasowanie, a w drugiej kolejności największa melina,
+      // którą da się opróżnić - dzięki temu zwalniamy miejsce dla winiarzy
+      if (fitting != by_amount.end() && fitting->first == demand) {
+        return fitting->second;
+      }
+      if (fitting != by_amount.begin()) {
+        return std::prev(fitting)->second;
+      }
+      return fitting->second;
+    }
+
+    return -1;
+  }
+};
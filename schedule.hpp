@@ -0,0 +1,115 @@
+#pragma once
+
+#include "config.hpp"
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Zapis i odtwarzanie harmonogramu jednego strumienia zdarzeń procesu
+// (np. kolejności odbieranych wiadomości albo wylosowanych wartości).
+// Wpisy to N liczb int zapisywanych binarnie do <schedule_dir>/<pid>.<stream>.
+// Gdy odtwarzany zapis się skończy, proces wraca do zwykłego działania.
+template <int N> class Schedule {
+public:
+  using Entry = std::array<int, N>;
+
+private:
+  Config::ScheduleMode mode;
+  std::chrono::milliseconds flush_interval;
+  std::fstream file;
+  std::vector<Entry> buffer;
+  std::chrono::steady_clock::time_point last_flush;
+  std::optional<Entry> lookahead;
+
+public:
+  Schedule(Config &config, int pid, const std::string &stream)
+      : mode(config.schedule_mode),
+        flush_interval(config.schedule_flush_interval_ms),
+        last_flush(std::chrono::steady_clock::now()) {
+    if (mode == Config::ScheduleMode::NONE) {
+      return;
+    }
+
+    auto path = config.schedule_dir + "/" + std::to_string(pid) + "." + stream;
+    if (mode == Config::ScheduleMode::RECORD) {
+      std::error_code error;
+      std::filesystem::create_directories(config.schedule_dir, error);
+      file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    } else {
+      file.open(path, std::ios::in | std::ios::binary);
+    }
+
+    if (!file) {
+      std::cerr << "Nie można otworzyć pliku harmonogramu " << path << "\n";
+      mode = Config::ScheduleMode::NONE;
+    }
+  }
+
+  ~Schedule() { flush(); }
+
+  // Następny odtwarzany wpis; false, jeśli nie odtwarzamy albo zapis się
+  // skończył
+  bool next(Entry &entry) {
+    if (!peek(entry)) {
+      return false;
+    }
+    lookahead.reset();
+    return true;
+  }
+
+  // Jak next(), ale bez zdejmowania wpisu
+  bool peek(Entry &entry) {
+    if (mode != Config::ScheduleMode::REPLAY) {
+      return false;
+    }
+
+    if (!lookahead) {
+      lookahead.emplace();
+      if (!file.read(reinterpret_cast<char *>(lookahead->data()),
+                     sizeof(Entry))) {
+        stop();
+        return false;
+      }
+    }
+    entry = *lookahead;
+    return true;
+  }
+
+  // Przerywa odtwarzanie albo zapis; dalej proces działa normalnie
+  void stop() {
+    flush();
+    lookahead.reset();
+    mode = Config::ScheduleMode::NONE;
+  }
+
+  void record(const Entry &entry) {
+    if (mode != Config::ScheduleMode::RECORD) {
+      return;
+    }
+
+    buffer.push_back(entry);
+    if (std::chrono::steady_clock::now() - last_flush >= flush_interval) {
+      flush();
+    }
+  }
+
+  // Procesy nigdy nie kończą się same, więc zapis jest co
+  // schedule_flush_interval_ms zrzucany na dysk, żeby przetrwał przerwanie
+  // programu
+  void flush() {
+    last_flush = std::chrono::steady_clock::now();
+    if (buffer.empty()) {
+      return;
+    }
+
+    file.write(reinterpret_cast<const char *>(buffer.data()),
+               buffer.size() * sizeof(Entry));
+    file.flush();
+    buffer.clear();
+  }
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "config.hpp"
+#include "messages.hpp"
+#include "payload.hpp"
+#include "transmitter.hpp"
+#include <chrono>
+#include <functional>
+#include <mpi.h>
+#include <vector>
+
+// Rozmiar pojedynczego zdarzenia w paczce: message, _pid i Payload
+constexpr int TELEMETRY_EVENT_SIZE = 5;
+
+void forEachTelemetryEvent(
+    const std::vector<int> &batch,
+    std::function<void(int, int, const Payload &)> callback) {
+  for (size_t i = 1; i + TELEMETRY_EVENT_SIZE <= batch.size();
+       i += TELEMETRY_EVENT_SIZE) {
+    Payload payload;
+    payload.deserialize({batch[i + 2], batch[i + 3], batch[i + 4]});
+    callback(batch[i], batch[i + 1], payload);
+  }
+}
+
+// Bufor zdarzeń dla obserwatora. Zdarzenia nie trafiają bezpośrednio do
+// procesu 0, tylko do rodzica w drzewie agregacji, i to dopiero gdy
+// uzbiera się ich telemetry_batch_size albo minie telemetry_flush_interval_ms
+// (sprawdzane przy każdym zdarzeniu i w flushIfStale()).
+// Używany tylko z jednego wątku, więc bufor nie jest chroniony mutexem.
+class Telemetry {
+  Config &config;
+  int pid;
+  int parent;
+  MessageTransmitter t;
+
+  std::vector<int> buffer;
+  std::chrono::steady_clock::time_point last_flush;
+
+public:
+  Telemetry(Config &config, int pid)
+      : config(config), pid(pid), parent(config.getTelemetryParent(pid)),
+        buffer(1, 0), last_flush(std::chrono::steady_clock::now()) {}
+
+  // Zdarzenie oznaczamy zegarem Lamporta agenta (a nie zegarem transmitera
+  // telemetrii), żeby obserwator mógł ułożyć zdarzenia różnych procesów
+  // w kolejności przyczynowej
+  void send(int message, Payload &&payload, int clock) {
+    payload.clock = clock;
+    push(message, pid, payload);
+  }
+
+  void forward(const std::vector<int> &batch) {
+    forEachTelemetryEvent(batch,
+                          [&](int message, int source, const Payload &payload) {
+                            push(message, source, payload);
+                          });
+  }
+
+  bool empty() const { return buffer.size() == 1; }
+
+  bool stale() const {
+    auto elapsed = std::chrono::steady_clock::now() - last_flush;
+    return elapsed >=
+           std::chrono::milliseconds(config.telemetry_flush_interval_ms);
+  }
+
+  // Proces, który długo nic nie wysyła (np. czeka na ACK), woła to
+  // w pętli, żeby jego zdarzenia i zegar nie utknęły w buforze
+  void flushIfStale() {
+    if (!empty() && stale()) {
+      flush();
+    }
+  }
+
+  void flush() {
+    if (!empty()) {
+      t.sendBatch(ObserverMessage::TELEMETRY_BATCH, buffer, parent);
+      buffer.resize(1);
+    }
+    last_flush = std::chrono::steady_clock::now();
+  }
+
+private:
+  void push(int message, int source, const Payload &payload) {
+    auto serialized = payload.serialize();
+    buffer.push_back(message);
+    buffer.push_back(source);
+    buffer.insert(buffer.end(), serialized.begin(), serialized.end());
+
+    int events = (buffer.size() - 1) / TELEMETRY_EVENT_SIZE;
+    if (events >= config.telemetry_batch_size || stale()) {
+      flush();
+    }
+  }
+};
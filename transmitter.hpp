@@ -1,9 +1,13 @@
 #pragma once
 
 #include "payload.hpp"
+#include "schedule.hpp"
 #include "utils.hpp"
+#include <chrono>
+#include <memory>
 #include <mpi.h>
 #include <mutex>
+#include <vector>
 
 struct MessageTransmitter {
   struct Response {
@@ -12,9 +16,25 @@ struct MessageTransmitter {
     Payload payload;
   };
 
+  struct BatchResponse {
+    int message;
+    int source;
+    std::vector<int> data;
+  };
+
   int clock = 0;
   std::mutex clock_mutex;
 
+  // Kolejność odbioru: (source, message, clock) każdej odebranej wiadomości
+  std::unique_ptr<Schedule<3>> schedule;
+  std::chrono::milliseconds replay_timeout{0};
+
+  void useSchedule(Config &config, int pid) {
+    schedule = std::make_unique<Schedule<3>>(config, pid, "receive");
+    replay_timeout =
+        std::chrono::milliseconds(config.schedule_replay_timeout_ms);
+  }
+
   void setClock(int value) {
     clock_mutex.lock();
     this->clock = value;
@@ -28,6 +48,13 @@ struct MessageTransmitter {
     return copy;
   }
 
+  int tick() {
+    clock_mutex.lock();
+    int copy = ++this->clock;
+    clock_mutex.unlock();
+    return copy;
+  }
+
   void send(int message, Payload &&payload, int dest) {
     clock_mutex.lock();
     this->clock++;
@@ -54,6 +81,9 @@ struct MessageTransmitter {
     Response response;
     MPI_Status status;
 
+    Schedule<3>::Entry entry;
+    bool replayed = replaySource(message, source, entry);
+
     auto array = response.payload.serialize();
     MPI_Recv(array.data(), array.size(), MPI_INT, source, message,
              MPI_COMM_WORLD, &status);
@@ -61,6 +91,8 @@ struct MessageTransmitter {
     response.payload.deserialize(array);
     response.message = status.MPI_TAG;
     response.source = status.MPI_SOURCE;
+    recordSchedule(response.source, response.message,
+                   response.payload.clock, replayed, entry);
 
     {
       clock_mutex.lock();
@@ -70,4 +102,115 @@ struct MessageTransmitter {
 
     return response;
   }
+
+  // Wiadomość o zmiennej długości; data[0] jest zarezerwowane na zegar
+  void sendBatch(int message, std::vector<int> &data, int dest) {
+    clock_mutex.lock();
+    this->clock++;
+    data[0] = this->clock;
+    MPI_Send(data.data(), data.size(), MPI_INT, dest, message, MPI_COMM_WORLD);
+    clock_mutex.unlock();
+  }
+
+  // Przy odtwarzaniu najpierw patrzymy na nadawcę z nagrania, ale gotowa
+  // wiadomość od innego procesu też się liczy - inaczej proces, który
+  // sprawdza skrzynkę w pętli, nie doszedłby do receiveBatch() i jego
+  // limitu czasu, gdyby nagrany nadawca nigdy nie wysłał
+  bool probe(int message, int source) {
+    Schedule<3>::Entry entry;
+    int flag = 0;
+    if (schedule && schedule->peek(entry)) {
+      MPI_Iprobe(entry[0], message, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+    }
+    if (!flag) {
+      MPI_Iprobe(source, message, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+    }
+    return flag;
+  }
+
+  BatchResponse receiveBatch(int message, int source) {
+    BatchResponse response;
+    MPI_Status status;
+
+    Schedule<3>::Entry entry;
+    bool replayed = replaySource(message, source, entry);
+
+    MPI_Probe(source, message, MPI_COMM_WORLD, &status);
+    int count;
+    MPI_Get_count(&status, MPI_INT, &count);
+
+    response.data.resize(count);
+    MPI_Recv(response.data.data(), count, MPI_INT, status.MPI_SOURCE,
+             status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    response.message = status.MPI_TAG;
+    response.source = status.MPI_SOURCE;
+    recordSchedule(response.source, response.message, response.data[0],
+                   replayed, entry);
+
+    {
+      clock_mutex.lock();
+      this->clock = std::max(this->clock, response.data[0]) + 1;
+      clock_mutex.unlock();
+    }
+
+    return response;
+  }
+
+private:
+  // Wymuszamy tylko nadawcę - wiadomości od jednego nadawcy i tak
+  // przychodzą po kolei, a wymuszony znacznik mógłby wyprzedzić
+  // wcześniejszą wiadomość (np. ACK przed SAFE_PLACE_UPDATED). Jeśli
+  // nagrany nadawca nic nie wyśle przez replay_timeout, przebieg już się
+  // rozjechał (nadawca może np. sam czekać na ACK od tego procesu), więc
+  // kończymy odtwarzanie i odbieramy od dowolnego procesu.
+  bool replaySource(int message, int &source, Schedule<3>::Entry &entry) {
+    if (!schedule || !schedule->next(entry)) {
+      return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + replay_timeout;
+    int flag = 0;
+    MPI_Iprobe(entry[0], message, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+    while (!flag && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::yield();
+      MPI_Iprobe(entry[0], message, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+    }
+
+    if (!flag) {
+      print.lock();
+      std::cerr << process::rank << "Przebieg odbiega od nagrania: brak "
+                << "wiadomości od procesu " << entry[0]
+                << ", koniec odtwarzania\n";
+      print.unlock();
+      schedule->stop();
+      return false;
+    }
+
+    source = entry[0];
+    return true;
+  }
+
+  // Inna wiadomość albo inny zegar nadawcy niż w nagraniu oznacza, że
+  // przebieg rozjechał się z nagraniem (np. przez inny przeplot wątków
+  // wewnątrz procesu nadawcy), więc dalsze wymuszanie kolejności nie ma
+  // sensu i wracamy do zwykłego odbioru.
+  void recordSchedule(int source, int message, int clock, bool replayed,
+                      const Schedule<3>::Entry &entry) {
+    if (!schedule) {
+      return;
+    }
+
+    if (replayed && (entry[1] != message || entry[2] != clock)) {
+      print.lock();
+      std::cerr << process::rank << "Przebieg odbiega od nagrania: wiadomość "
+                << message << " z zegarem " << clock << " zamiast "
+                << entry[1] << " z zegarem " << entry[2] << " od procesu "
+                << source << ", koniec odtwarzania\n";
+      print.unlock();
+      schedule->stop();
+      return;
+    }
+
+    schedule->record({source, message, clock});
+  }
 };
@@ -1,19 +1,63 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
-#include <cstdlib>
 #include <iostream>
 #include <mutex>
 #include <thread>
 
-// Range: [min, max)
-int randint(int min, int max) { return min + (rand() % (max - min)); }
+// Rozmiar linii pamięci podręcznej, do którego wyrównujemy pola
+// współdzielone między wątkami
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Odliczanie brakujących ACK: ustawiane przez wątek pierwszoplanowy przed
+// wysłaniem REQUEST, zmniejszane przez wątek w tle. Zajmuje własną linię
+// pamięci podręcznej, żeby nie kolidować z resztą stanu procesu.
+struct alignas(CACHE_LINE_SIZE) AckCountdown {
+  std::atomic<int> remaining{0};
+
+  void reset(int acks) { remaining.store(acks, std::memory_order_release); }
+
+  void ack() { remaining.fetch_sub(1, std::memory_order_release); }
+
+  bool pending() const {
+    return remaining.load(std::memory_order_acquire) > 0;
+  }
+
+  // Oddajemy procesor między sprawdzeniami, żeby nie zagłodzić wątku,
+  // który odbiera ACK, gdy oba dzielą jeden procesor. idle() jest wołane
+  // w każdym obrocie pętli.
+  template <typename Idle> void wait(Idle &&idle) const {
+    while (pending()) {
+      idle();
+      std::this_thread::yield();
+    }
+  }
+
+  void wait() const { wait([] {}); }
+};
 
 void sleep(int milliseconds) {
   auto duration = std::chrono::milliseconds(milliseconds);
   // std::this_thread::sleep_for(duration);
 }
 
+struct LatencyStats {
+  std::chrono::steady_clock::duration total{};
+  int count = 0;
+
+  void add(std::chrono::steady_clock::duration duration) {
+    total += duration;
+    count++;
+  }
+
+  double meanMicroseconds() const {
+    return std::chrono::duration<double, std::micro>(total).count() / count;
+  }
+
+  void reset() { *this = LatencyStats(); }
+};
+
 namespace process {
 struct Rank {
 } rank;
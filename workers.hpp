@@ -2,7 +2,10 @@
 
 #include <algorithm>
 #include <atomic>
+#include <climits>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <mpi.h>
@@ -10,10 +13,14 @@
 #include <thread>
 #include <vector>
 
+#include "affinity.hpp"
 #include "messages.hpp"
 #include "payload.hpp"
+#include "safe_places.hpp"
+#include "telemetry.hpp"
 #include "transmitter.hpp"
 #include "utils.hpp"
+#include "workload.hpp"
 
 struct Runnable {
   virtual void run() = 0;
@@ -31,6 +38,30 @@ class Observer : public Runnable {
   std::vector<bool> students_resting;
   int free_safe_places;
 
+  // Ile melin student musiał ruszyć, żeby zebrać wino na imprezę
+  int student_updates = 0;
+  int pickups = 0;
+
+  // Paczki różnych procesów (zwłaszcza idące różnymi ścieżkami drzewa
+  // agregacji) mogą się wyprzedzać, więc zdarzenia są obsługiwane
+  // w kolejności zegarów Lamporta. Zdarzenie można obsłużyć, gdy każdy
+  // winiarz i student przysłał już coś z nie mniejszym zegarem - strumień
+  // zdarzeń jednego procesu przychodzi po kolei i ma rosnące zegary.
+  struct PendingEvent {
+    int message;
+    int source;
+    Payload payload;
+
+    bool operator>(const PendingEvent &other) const {
+      return std::make_pair(payload.clock, source) >
+             std::make_pair(other.payload.clock, other.source);
+    }
+  };
+  std::priority_queue<PendingEvent, std::vector<PendingEvent>,
+                      std::greater<PendingEvent>>
+      pending;
+  std::vector<int> last_clocks;
+
 public:
   Observer(Config &config, int pid)
       : config(config), pid(pid), free_safe_places(config.safe_places),
@@ -38,94 +69,128 @@ public:
         students_wine_needs(config.students, 0),
         safe_places_wine_amounts(config.safe_places, 0),
         winemakers_working(config.winemakers, false),
-        students_resting(config.students, false) {}
+        students_resting(config.students, false),
+        last_clocks(config.getTotalProcessesNumber(), -1) {
+    t.useSchedule(config, pid);
+  }
 
   void run() override {
     while (true) {
-      auto response = t.receive(MPI_ANY_TAG, MPI_ANY_SOURCE);
-      const auto &payload = response.payload;
-
-      switch (response.message) {
-      case ObserverMessage::WINEMAKER_PRODUCTION_STARTED: {
-        auto wid = config.getWinemakerIdFromPid(response.source);
-        winemakers_working[wid] = true;
-        std::cout << "Winiarz o id " << wid + 1 << " rozpoczął produkcję\n";
-        break;
+      auto response =
+          t.receiveBatch(ObserverMessage::TELEMETRY_BATCH, MPI_ANY_SOURCE);
+
+      forEachTelemetryEvent(
+          response.data, [&](int message, int source, const Payload &payload) {
+            last_clocks[source] = std::max(last_clocks[source], payload.clock);
+            if (message != ObserverMessage::TELEMETRY_WATERMARK) {
+              pending.push({message, source, payload});
+            }
+          });
+
+      int watermark = INT_MAX;
+      config.forEachWinemakerAndStudent([&](int process_id) {
+        watermark = std::min(watermark, last_clocks[process_id]);
+      });
+
+      while (!pending.empty() && pending.top().payload.clock <= watermark) {
+        auto event = pending.top();
+        pending.pop();
+        handleEvent(event.message, event.source, event.payload);
+        printState();
+        std::cout << "\n";
       }
+    }
+  }
 
-      case ObserverMessage::WINEMAKER_PRODUCTION_END: {
-        auto wid = config.getWinemakerIdFromPid(response.source);
-        winemakers_working[wid] = false;
-        winemakers_wine_amounts[wid] = payload.wine_amount;
-
-        std::cout << "Winiarz o id " << wid + 1
-                  << " zakończył produkcję i wyprodukował "
-                  << payload.wine_amount << " jednostek wina\n";
+  void handleEvent(int message, int source, const Payload &payload) {
+    switch (message) {
+    case ObserverMessage::WINEMAKER_PRODUCTION_STARTED: {
+      auto wid = config.getWinemakerIdFromPid(source);
+      winemakers_working[wid] = true;
+      std::cout << "Winiarz o id " << wid + 1 << " rozpoczął produkcję\n";
+      break;
+    }
 
-        break;
-      }
+    case ObserverMessage::WINEMAKER_PRODUCTION_END: {
+      auto wid = config.getWinemakerIdFromPid(source);
+      winemakers_working[wid] = false;
+      winemakers_wine_amounts[wid] = payload.wine_amount;
 
-      case ObserverMessage::STUDENT_DOESNT_WANT_TO_PARTY_ANYMORE: {
-        auto sid = config.getStudentIdFromPid(response.source);
-        students_resting[sid] = true;
-        std::cout << "Student o id " << sid + 1 << " ma kaca\n";
-        break;
-      }
+      std::cout << "Winiarz o id " << wid + 1
+                << " zakończył produkcję i wyprodukował "
+                << payload.wine_amount << " jednostek wina\n";
 
-      case ObserverMessage::STUDENT_WANT_TO_PARTY: {
-        auto sid = config.getStudentIdFromPid(response.source);
-        students_resting[sid] = false;
-        students_wine_needs[sid] = payload.wine_amount;
+      break;
+    }
 
-        std::cout << "Student o id " << sid + 1
-                  << " wyleczył kaca i potrzebuje " << payload.wine_amount
-                  << " jednostek wina na kolejną imprezę\n";
-        break;
-      }
+    case ObserverMessage::STUDENT_DOESNT_WANT_TO_PARTY_ANYMORE: {
+      auto sid = config.getStudentIdFromPid(source);
+      students_resting[sid] = true;
+      std::cout << "Student o id " << sid + 1 << " ma kaca\n";
+      break;
+    }
 
-      case ObserverMessage::WINEMAKER_SAFE_PLACE_UPDATED: {
-        auto wid = config.getWinemakerIdFromPid(response.source);
-        auto spid = payload.safe_place_id;
-        auto &r = safe_places_wine_amounts[spid];
+    case ObserverMessage::STUDENT_WANT_TO_PARTY: {
+      auto sid = config.getStudentIdFromPid(source);
+      students_resting[sid] = false;
+      students_wine_needs[sid] = payload.wine_amount;
 
-        auto increase = payload.wine_amount - r;
-        if (r == 0 && increase > 0) {
-          free_safe_places--;
-        }
-        r = payload.wine_amount;
-        winemakers_wine_amounts[wid] -= increase;
+      std::cout << "Student o id " << sid + 1
+                << " wyleczył kaca i potrzebuje " << payload.wine_amount
+                << " jednostek wina na kolejną imprezę\n";
+      break;
+    }
 
-        std::cout << "Winiarz o id " << wid + 1 << " przyniósł " << increase
-                  << " jednostek wina, do meliny nr " << spid + 1 << "\n";
+    case ObserverMessage::WINEMAKER_SAFE_PLACE_UPDATED: {
+      auto wid = config.getWinemakerIdFromPid(source);
+      auto spid = payload.safe_place_id;
+      auto &r = safe_places_wine_amounts[spid];
 
-        std::cout << "Aktualna liczba pustych melin to " << free_safe_places
-                  << "\n";
-        break;
+      auto increase = payload.wine_amount - r;
+      if (r == 0 && increase > 0) {
+        free_safe_places--;
       }
+      r = payload.wine_amount;
+      winemakers_wine_amounts[wid] -= increase;
 
-      case ObserverMessage::STUDENT_SAFE_PLACE_UPDATED: {
-        auto sid = config.getStudentIdFromPid(response.source);
-        auto spid = payload.safe_place_id;
-        auto &r = safe_places_wine_amounts[spid];
+      std::cout << "Winiarz o id " << wid + 1 << " przyniósł " << increase
+                << " jednostek wina, do meliny nr " << spid + 1 << "\n";
 
-        auto decrease = r - payload.wine_amount;
-        r = payload.wine_amount;
-        students_wine_needs[sid] -= decrease;
-        if (r == 0 && decrease > 0) {
-          free_safe_places++;
-        }
+      std::cout << "Aktualna liczba pustych melin to " << free_safe_places
+                << "\n";
+      break;
+    }
 
-        std::cout << "Student o id " << sid + 1 << " zabrał " << decrease
-                  << " jednostek wina, z meliny nr " << spid + 1 << "\n";
+    case ObserverMessage::STUDENT_SAFE_PLACE_UPDATED: {
+      auto sid = config.getStudentIdFromPid(source);
+      auto spid = payload.safe_place_id;
+      auto &r = safe_places_wine_amounts[spid];
 
-        std::cout << "Aktualna liczba pustych melin to " << free_safe_places
-                  << "\n";
-        break;
+      auto decrease = r - payload.wine_amount;
+      r = payload.wine_amount;
+      students_wine_needs[sid] -= decrease;
+      if (r == 0 && decrease > 0) {
+        free_safe_places++;
       }
+      if (decrease > 0) {
+        student_updates++;
+        if (students_wine_needs[sid] == 0) {
+          pickups++;
+        }
       }
 
-      printState();
-      std::cout << "\n";
+      std::cout << "Student o id " << sid + 1 << " zabrał " << decrease
+                << " jednostek wina, z meliny nr " << spid + 1 << "\n";
+
+      std::cout << "Aktualna liczba pustych melin to " << free_safe_places
+                << "\n";
+
+      if (pickups > 0) {
+        std::cout << "Średnia liczba aktualizacji melin na odbiór to "
+                  << double(student_updates) / pickups << "\n";
+      }
+      break;
+    }
     }
   }
 
@@ -169,10 +234,57 @@ public:
   }
 };
 
+// Węzeł pośredni drzewa agregacji telemetrii: zbiera paczki od dzieci
+// i przekazuje je dalej w większych paczkach, żeby proces 0 nie musiał
+// odbierać wiadomości od wszystkich procesów.
+class Aggregator : public Runnable {
+  Config &config;
+  int pid;
+  MessageTransmitter t;
+  Telemetry telemetry;
+
+public:
+  Aggregator(Config &config, int pid)
+      : config(config), pid(pid), telemetry(config, pid) {
+    t.useSchedule(config, pid);
+  }
+
+  void run() override {
+    while (true) {
+      if (!telemetry.empty() &&
+          !t.probe(ObserverMessage::TELEMETRY_BATCH, MPI_ANY_SOURCE)) {
+        if (telemetry.stale()) {
+          telemetry.flush();
+        } else {
+          std::this_thread::yield();
+        }
+        continue;
+      }
+
+      auto response =
+          t.receiveBatch(ObserverMessage::TELEMETRY_BATCH, MPI_ANY_SOURCE);
+      telemetry.forward(response.data);
+    }
+  }
+};
+
 class WorkingProcess : public Runnable {
 public:
+  explicit WorkingProcess(bool pin_threads) : pin_threads(pin_threads) {}
+
   void run() {
-    thread = std::move(std::thread(&WorkingProcess::backgroundTask, this));
+    // Nowy wątek dziedziczy przypięcie do całego rdzenia, a potem każdy
+    // z wątków zajmuje osobny hyperwątek tego rdzenia
+    thread = std::move(std::thread([this] {
+      if (pin_threads) {
+        pinThreadToSibling(1);
+      }
+      backgroundTask();
+    }));
+
+    if (pin_threads) {
+      pinThreadToSibling(0);
+    }
     foregroundTask();
   }
 
@@ -181,29 +293,40 @@ protected:
   virtual void backgroundTask() = 0;
 
 private:
+  bool pin_threads;
   std::thread thread;
 };
 
 struct Winemaker : public WorkingProcess {
-  Config &config;
-  int pid;
-  MessageTransmitter t, ot;
+  // Pola są pogrupowane tak, żeby wątek w tle i wątek pierwszoplanowy
+  // nie unieważniały sobie nawzajem linii pamięci podręcznej.
 
-  int wine_available = 0;
-  std::vector<int> safe_places_wine_amounts;
+  AckCountdown ack_counter;
 
+  // Stan chroniony przez data_mutex
+  alignas(CACHE_LINE_SIZE) std::mutex data_mutex;
   bool want_to_enter_critical_section = false;
-  bool wait_ready = false;
-  std::mutex wait_ready_mutex;
-
-  int ack_counter;
   int request_clock = 0;
+  int wine_available = 0;
   std::queue<int> wait_queue;
-  std::mutex data_mutex;
+  SafePlaces safe_places;
+
+  // Transmiter używany przez oba wątki ma własny zegar i mutex
+  alignas(CACHE_LINE_SIZE) MessageTransmitter t;
+
+  // Dane używane tylko przez wątek pierwszoplanowy
+  alignas(CACHE_LINE_SIZE) Telemetry telemetry;
+  Workload workload;
+  LatencyStats ack_latency;
+  Config &config;
+  int pid;
 
   Winemaker(Config &config, int pid)
-      : config(config), pid(pid),
-        safe_places_wine_amounts(config.safe_places, 0) {}
+      : WorkingProcess(config.pinning != Config::Pinning::NONE),
+        safe_places(config.safe_places), telemetry(config, pid),
+        workload(config, pid), config(config), pid(pid) {
+    t.useSchedule(config, pid);
+  }
 
   void foregroundTask() override {
     while (true) {
@@ -222,20 +345,22 @@ struct Winemaker : public WorkingProcess {
   }
 
   void makeWine() {
-    ot.send(ObserverMessage::WINEMAKER_PRODUCTION_STARTED, Payload(), 0);
-    sleep(randint(1000, config.max_sleep_time * 1000));
+    telemetry.send(ObserverMessage::WINEMAKER_PRODUCTION_STARTED, Payload(),
+                   t.tick());
+    sleep(workload.sleepTime());
 
     data_mutex.lock();
-    wine_available = randint(1, config.max_wine_production);
-    ot.send(ObserverMessage::WINEMAKER_PRODUCTION_END,
-            Payload().setWineAmount(wine_available), 0);
+    wine_available = workload.production();
+    telemetry.send(ObserverMessage::WINEMAKER_PRODUCTION_END,
+                   Payload().setWineAmount(wine_available), t.tick());
     data_mutex.unlock();
   }
 
   void deliverWine() {
+    auto request_start = std::chrono::steady_clock::now();
     data_mutex.lock();
     want_to_enter_critical_section = true;
-    ack_counter = config.winemakers + config.students - 1;
+    ack_counter.reset(config.winemakers + config.students - 1);
 
     t.startBroadcast();
     config.forEachWinemakerAndStudent([&](int process_id) {
@@ -247,49 +372,47 @@ struct Winemaker : public WorkingProcess {
     request_clock = t.getClock();
     data_mutex.unlock();
 
-    while (true) {
-      wait_ready_mutex.lock();
-      bool x = wait_ready;
-      wait_ready_mutex.unlock();
+    ack_counter.wait([&] { telemetry.flushIfStale(); });
 
-      if (x) {
-        break;
-      }
+    ack_latency.add(std::chrono::steady_clock::now() - request_start);
+    if (ack_latency.count == config.ack_latency_report_interval) {
+      print.lock();
+      std::cout << process::rank << "Średni czas oczekiwania na ACK to "
+                << ack_latency.meanMicroseconds() << " us\n";
+      print.unlock();
+      ack_latency.reset();
     }
 
-    wait_ready_mutex.lock();
-    wait_ready = false;
-    wait_ready_mutex.unlock();
-
     data_mutex.lock();
     want_to_enter_critical_section = false;
     // CRITICAL SECTION START
-    for (int i = 0; i < config.safe_places; i++) {
-      if (safe_places_wine_amounts[i] == 0) {
-        safe_places_wine_amounts[i] = wine_available;
-        wine_available = 0;
-
-        auto payload = Payload().setSafePlaceId(i).setWineAmount(
-            safe_places_wine_amounts[i]);
-
-        auto payload_copy = payload;
-        ot.send(ObserverMessage::WINEMAKER_SAFE_PLACE_UPDATED,
-                std::move(payload_copy), 0);
-
-        t.startBroadcast();
-        config.forEachWinemakerAndStudent([&](int process_id) {
-          if (process_id != pid) {
-            auto payload_copy = payload;
-            t.sendBroadcast(CommonMessage::SAFE_PLACE_UPDATED,
-                            std::move(payload_copy), process_id);
-          }
-        });
-        t.stopBroadcast();
-
-        break;
-      }
+    // Wino trafia tylko do pustej meliny, więc wybór jest obojętny
+    if (int i = safe_places.findEmpty(); i >= 0) {
+      safe_places.set(i, wine_available, t.getClock());
+      wine_available = 0;
+
+      auto payload =
+          Payload().setSafePlaceId(i).setWineAmount(safe_places[i]);
+
+      auto payload_copy = payload;
+      telemetry.send(ObserverMessage::WINEMAKER_SAFE_PLACE_UPDATED,
+                     std::move(payload_copy), t.tick());
+
+      t.startBroadcast();
+      config.forEachWinemakerAndStudent([&](int process_id) {
+        if (process_id != pid) {
+          auto payload_copy = payload;
+          t.sendBroadcast(CommonMessage::SAFE_PLACE_UPDATED,
+                          std::move(payload_copy), process_id);
+        }
+      });
+      t.stopBroadcast();
     }
     // CRITICAL SECTION END
+    // Znacznik zegara pozwala obserwatorowi obsłużyć zdarzenia innych
+    // procesów także wtedy, gdy ten proces w sekcji niczego nie zmienił
+    telemetry.send(ObserverMessage::TELEMETRY_WATERMARK, Payload(),
+                   t.getClock());
     while (!wait_queue.empty()) {
       auto process_id = wait_queue.front();
       wait_queue.pop();
@@ -302,6 +425,13 @@ struct Winemaker : public WorkingProcess {
   void backgroundTask() override {
     while (true) {
       auto response = t.receive(MPI_ANY_TAG, MPI_ANY_SOURCE);
+
+      // ACK dotyczy tylko licznika, więc nie blokujemy data_mutex
+      if (response.message == CommonMessage::ACK) {
+        ack_counter.ack();
+        continue;
+      }
+
       data_mutex.lock();
       const auto &payload = response.payload;
 
@@ -322,19 +452,9 @@ struct Winemaker : public WorkingProcess {
         break;
       }
 
-      case CommonMessage::ACK: {
-        ack_counter--;
-        if (ack_counter == 0) {
-          wait_ready_mutex.lock();
-          wait_ready = true;
-          wait_ready_mutex.unlock();
-        }
-        break;
-      }
-
       case CommonMessage::SAFE_PLACE_UPDATED: {
         auto spid = payload.safe_place_id;
-        safe_places_wine_amounts[spid] = payload.wine_amount;
+        safe_places.set(spid, payload.wine_amount, payload.clock);
         break;
       }
       }
@@ -345,25 +465,35 @@ struct Winemaker : public WorkingProcess {
 };
 
 struct Student : public WorkingProcess {
-  Config &config;
-  int pid;
-  MessageTransmitter t, ot;
+  // Pola są pogrupowane tak, żeby wątek w tle i wątek pierwszoplanowy
+  // nie unieważniały sobie nawzajem linii pamięci podręcznej.
 
-  int wine_demand = 0;
-  std::vector<int> safe_places_wine_amounts;
+  AckCountdown ack_counter;
 
+  // Stan chroniony przez data_mutex
+  alignas(CACHE_LINE_SIZE) std::mutex data_mutex;
   bool want_to_enter_critical_section = false;
-  bool wait_ready = false;
-  std::mutex wait_ready_mutex;
-
-  int ack_counter;
   int request_clock = 0;
+  int wine_demand = 0;
   std::queue<int> wait_queue;
-  std::mutex data_mutex;
+  SafePlaces safe_places;
+
+  // Transmiter używany przez oba wątki ma własny zegar i mutex
+  alignas(CACHE_LINE_SIZE) MessageTransmitter t;
+
+  // Dane używane tylko przez wątek pierwszoplanowy
+  alignas(CACHE_LINE_SIZE) Telemetry telemetry;
+  Workload workload;
+  LatencyStats ack_latency;
+  Config &config;
+  int pid;
 
   Student(Config &config, int pid)
-      : config(config), pid(pid),
-        safe_places_wine_amounts(config.safe_places, 0) {}
+      : WorkingProcess(config.pinning != Config::Pinning::NONE),
+        safe_places(config.safe_places), telemetry(config, pid),
+        workload(config, pid), config(config), pid(pid) {
+    t.useSchedule(config, pid);
+  }
 
   void foregroundTask() override {
     while (true) {
@@ -382,21 +512,22 @@ struct Student : public WorkingProcess {
   }
 
   void drinkWine() {
-    ot.send(ObserverMessage::STUDENT_DOESNT_WANT_TO_PARTY_ANYMORE, Payload(),
-            0);
-    sleep(randint(1000, config.max_sleep_time * 1000));
+    telemetry.send(ObserverMessage::STUDENT_DOESNT_WANT_TO_PARTY_ANYMORE,
+                   Payload(), t.tick());
+    sleep(workload.sleepTime());
 
     data_mutex.lock();
-    wine_demand = randint(1, config.max_wine_demand);
-    ot.send(ObserverMessage::STUDENT_WANT_TO_PARTY,
-            Payload().setWineAmount(wine_demand), 0);
+    wine_demand = workload.demand();
+    telemetry.send(ObserverMessage::STUDENT_WANT_TO_PARTY,
+                   Payload().setWineAmount(wine_demand), t.tick());
     data_mutex.unlock();
   }
 
   void receiveWine() {
+    auto request_start = std::chrono::steady_clock::now();
     data_mutex.lock();
     want_to_enter_critical_section = true;
-    ack_counter = config.winemakers + config.students - 1;
+    ack_counter.reset(config.winemakers + config.students - 1);
 
     t.startBroadcast();
     config.forEachWinemakerAndStudent([&](int process_id) {
@@ -408,53 +539,53 @@ struct Student : public WorkingProcess {
     request_clock = t.getClock();
     data_mutex.unlock();
 
-    while (true) {
-      wait_ready_mutex.lock();
-      bool x = wait_ready;
-      wait_ready_mutex.unlock();
+    ack_counter.wait([&] { telemetry.flushIfStale(); });
 
-      if (x) {
-        break;
-      }
+    ack_latency.add(std::chrono::steady_clock::now() - request_start);
+    if (ack_latency.count == config.ack_latency_report_interval) {
+      print.lock();
+      std::cout << process::rank << "Średni czas oczekiwania na ACK to "
+                << ack_latency.meanMicroseconds() << " us\n";
+      print.unlock();
+      ack_latency.reset();
     }
 
-    wait_ready_mutex.lock();
-    wait_ready = false;
-    wait_ready_mutex.unlock();
-
     data_mutex.lock();
     want_to_enter_critical_section = false;
     // CRITICAL SECTION START
-    for (int i = 0; i < config.safe_places; i++) {
-      if (wine_demand == 0) {
+    while (wine_demand > 0) {
+      int i = safe_places.select(config.selection_policy, wine_demand);
+      if (i < 0) {
         break;
       }
 
-      if (safe_places_wine_amounts[i] > 0) {
-        auto quantity = std::min(wine_demand, safe_places_wine_amounts[i]);
-        wine_demand -= quantity;
-        safe_places_wine_amounts[i] -= quantity;
-
-        auto payload = Payload().setSafePlaceId(i).setWineAmount(
-            safe_places_wine_amounts[i]);
-
-        auto payload_copy = payload;
-        ot.send(ObserverMessage::STUDENT_SAFE_PLACE_UPDATED,
-                std::move(payload_copy), 0);
-
-        t.startBroadcast();
-        config.forEachWinemakerAndStudent([&](int process_id) {
-          if (process_id != pid) {
-            auto payload_copy = payload;
-            t.sendBroadcast(CommonMessage::SAFE_PLACE_UPDATED,
-                            std::move(payload_copy), process_id);
-          }
-        });
-        t.stopBroadcast();
-      }
+      auto quantity = std::min(wine_demand, safe_places[i]);
+      wine_demand -= quantity;
+      safe_places.set(i, safe_places[i] - quantity, t.getClock());
+
+      auto payload =
+          Payload().setSafePlaceId(i).setWineAmount(safe_places[i]);
+
+      auto payload_copy = payload;
+      telemetry.send(ObserverMessage::STUDENT_SAFE_PLACE_UPDATED,
+                     std::move(payload_copy), t.tick());
+
+      t.startBroadcast();
+      config.forEachWinemakerAndStudent([&](int process_id) {
+        if (process_id != pid) {
+          auto payload_copy = payload;
+          t.sendBroadcast(CommonMessage::SAFE_PLACE_UPDATED,
+                          std::move(payload_copy), process_id);
+        }
+      });
+      t.stopBroadcast();
     }
 
     // CRITICAL SECTION END
+    // Znacznik zegara pozwala obserwatorowi obsłużyć zdarzenia innych
+    // procesów także wtedy, gdy ten proces w sekcji niczego nie zmienił
+    telemetry.send(ObserverMessage::TELEMETRY_WATERMARK, Payload(),
+                   t.getClock());
     while (!wait_queue.empty()) {
       auto process_id = wait_queue.front();
       wait_queue.pop();
@@ -467,6 +598,13 @@ struct Student : public WorkingProcess {
   void backgroundTask() override {
     while (true) {
       auto response = t.receive(MPI_ANY_TAG, MPI_ANY_SOURCE);
+
+      // ACK dotyczy tylko licznika, więc nie blokujemy data_mutex
+      if (response.message == CommonMessage::ACK) {
+        ack_counter.ack();
+        continue;
+      }
+
       data_mutex.lock();
       const auto &payload = response.payload;
 
@@ -487,19 +625,9 @@ struct Student : public WorkingProcess {
         break;
       }
 
-      case CommonMessage::ACK: {
-        ack_counter--;
-        if (ack_counter == 0) {
-          wait_ready_mutex.lock();
-          wait_ready = true;
-          wait_ready_mutex.unlock();
-        }
-        break;
-      }
-
       case CommonMessage::SAFE_PLACE_UPDATED: {
         auto spid = payload.safe_place_id;
-        safe_places_wine_amounts[spid] = payload.wine_amount;
+        safe_places.set(spid, payload.wine_amount, payload.clock);
         break;
       }
       }
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "config.hpp"
+#include "schedule.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// xoshiro256** - szybki generator, którego stan należy do jednego agenta,
+// więc nie współdzielimy globalnego stanu rand() między wątkami
+struct Rng {
+  uint64_t s[4];
+
+  explicit Rng(uint64_t seed) {
+    // splitmix64 rozprowadza ziarno na cały stan
+    for (auto &word : s) {
+      seed += 0x9e3779b97f4a7c15ULL;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  uint64_t next() {
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  // Range: [0, 1)
+  double uniform() { return (next() >> 11) * 0x1.0p-53; }
+
+  // Range: [min, max)
+  int randint(int min, int max) {
+    uint64_t range = max - min;
+    return min + static_cast<int>(((next() >> 32) * range) >> 32);
+  }
+};
+
+// Losowanie wartości z przedziału [min, max) według wybranego rozkładu.
+// Czas odpoczynku (think_time) losowany jest inaczej niż ilości wina.
+class Sampler {
+  Config::Distribution distribution;
+  int min, max;
+  bool think_time;
+  double burst_switch_probability;
+
+  std::vector<double> zipf_cdf;
+  bool &burst_on;
+
+public:
+  // burst_on jest wspólne dla wszystkich samplerów agenta, żeby w stanie
+  // "on" jednocześnie rosły ilości i skracały się przerwy
+  Sampler(Config &config, Config::Distribution distribution, int min, int max,
+          bool &burst_on, bool think_time = false)
+      : distribution(distribution), min(min), max(std::max(max, min + 1)),
+        think_time(think_time),
+        burst_switch_probability(config.burst_switch_probability),
+        burst_on(burst_on) {
+    if (distribution == Config::Distribution::ZIPF) {
+      double sum = 0;
+      for (int k = 1; k <= this->max - min; k++) {
+        sum += 1.0 / std::pow(k, config.zipf_exponent);
+        zipf_cdf.push_back(sum);
+      }
+      for (auto &p : zipf_cdf) {
+        p /= sum;
+      }
+    }
+  }
+
+  int draw(Rng &rng) {
+    switch (distribution) {
+    case Config::Distribution::UNIFORM:
+      return rng.randint(min, max);
+
+    case Config::Distribution::POISSON: {
+      double mean = (min + max - 1) / 2.0;
+
+      // Napływ Poissona: odstępy między zgłoszeniami mają rozkład
+      // wykładniczy (przesunięty o min, ze średnią w środku przedziału)
+      if (think_time) {
+        double gap = -std::log(1 - rng.uniform()) * (mean - min);
+        return std::clamp<int>(min + std::lround(gap), min, max - 1);
+      }
+
+      // Ilości: liczba zdarzeń Poissona ze średnią w środku przedziału.
+      // Dla małych średnich metoda Knutha, dla dużych przybliżenie
+      // rozkładem normalnym.
+      int k = -1;
+      if (mean < 30) {
+        double limit = std::exp(-mean);
+        double p = 1.0;
+        do {
+          k++;
+          p *= rng.uniform();
+        } while (p > limit);
+      } else {
+        double z = std::sqrt(-2 * std::log(1 - rng.uniform())) *
+                   std::cos(2 * M_PI * rng.uniform());
+        k = std::lround(mean + std::sqrt(mean) * z);
+      }
+      return std::clamp(k, min, max - 1);
+    }
+
+    case Config::Distribution::ZIPF: {
+      // Najczęściej najmniejsze wartości, rzadko duże
+      auto it = std::lower_bound(zipf_cdf.begin(), zipf_cdf.end(),
+                                 rng.uniform());
+      auto k = std::min<int>(it - zipf_cdf.begin(), zipf_cdf.size() - 1);
+      return min + k;
+    }
+
+    case Config::Distribution::BURSTY: {
+      // Dwa stany: w "on" duże ilości wina i krótkie przerwy, w "off"
+      // małe ilości i długie przerwy
+      if (rng.uniform() < burst_switch_probability) {
+        burst_on = !burst_on;
+      }
+      int mid = min + (max - min) / 2;
+      bool upper_half = burst_on != think_time;
+      return upper_half ? rng.randint(mid, max)
+                        : rng.randint(min, std::max(mid, min + 1));
+    }
+    }
+
+    return min;
+  }
+};
+
+// Generator obciążenia pojedynczego agenta. Ziarno zależy tylko od
+// Config::seed i pid, więc przebieg jest powtarzalny. Wylosowane wartości
+// trafiają też do harmonogramu, żeby odtworzenie nie zależało od zmian
+// w samych rozkładach.
+class Workload {
+  Rng rng;
+  Schedule<1> schedule;
+  bool burst_on = true;
+  Sampler production_sampler;
+  Sampler demand_sampler;
+  Sampler sleep_sampler;
+
+public:
+  Workload(Config &config, int pid)
+      : rng((uint64_t(config.seed) << 32) ^ pid),
+        schedule(config, pid, "workload"),
+        production_sampler(config, config.production_distribution, 1,
+                           config.max_wine_production, burst_on),
+        demand_sampler(config, config.demand_distribution, 1,
+                       config.max_wine_demand, burst_on),
+        sleep_sampler(config, config.sleep_distribution, 1000,
+                      config.max_sleep_time * 1000, burst_on, true) {}
+
+  int production() { return draw(production_sampler); }
+
+  int demand() { return draw(demand_sampler); }
+
+  int sleepTime() { return draw(sleep_sampler); }
+
+private:
+  int draw(Sampler &sampler) {
+    Schedule<1>::Entry entry;
+    if (!schedule.next(entry)) {
+      entry[0] = sampler.draw(rng);
+    }
+    schedule.record(entry);
+    return entry[0];
+  }
+};